@@ -2,53 +2,36 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <windows.h>
 #include <direct.h> // Get cwd
 #include <gdiplus.h>
+#include <algorithm> // nth_element
 #include "mpi.h"
+#include "RawImage.h"
+#include "Fractal.h"
 
 using namespace Gdiplus;
 
 #define EDGE_PIXEL_NUM 400 // Aka. display_width
 #define COLOR_LEVEL_MAX 255
 #define BMP_PATH L"DemoMPI.bmp"
+#define RAW_PATH "Mandelbrot.raw" // Iteration counts, see RawImage.h
+#define CKPT_PATH "Dynamic.ckpt" // Checkpoint file of the master, removed after a successful run
+#define CKPT_MAGIC 0x54504B43 // "CKPT"
+#define CKPT_INTERVAL 5.0 // Min seconds between two checkpoints
+#define TASK_TIMEOUT_MIN 1.0 // Min seconds before a column is considered late
+#define TASK_TIMEOUT_FIRST 10.0 // Seconds before a column is considered late, until one has been measured
+#define TASK_TIMEOUT_FACTOR 4.0 // Then a column is late after this many times the TASK_TIME_PERCENTILE of the on-time columns
+#define TASK_TIME_PERCENTILE 0.95
+#define HANG_TIMEOUT_FACTOR 10.0 // Give up after this many deadlines without any result while every slave is late
+#define BLACKLIST_LIMIT 2 // Slaves beaten this many times by a speculative copy only get columns nobody else can take
+#define QUEUE_DEPTH 2 // Columns sent ahead to each slave, so it never waits for the master to wake up
+#define POLL_SPIN 0.01 // Seconds the master keeps polling after a result before it starts sleeping
+#define POLL_INTERVAL 1 // Milliseconds the master sleeps when no result is waiting
+
+typedef MandelbrotKernel FractalKernel; // Or JuliaKernel, MultibrotKernel<3>, BurningShipKernel
 
-struct Complex { // Define complex number with some operations
-    float real;
-    float imag;
-
-    Complex() : real(0.0), imag(0.0) {}
-    Complex(float r, float i) : real(r), imag(i) {}
-
-    Complex operator+(const Complex& other) { // complex + complex
-        return Complex(this->real + other.real, this->imag + other.imag);
-    }
-    Complex operator-(const Complex& other) { // complex - complex
-        return Complex(this->real - other.real, this->imag - other.imag);
-    }
-    Complex operator*(const Complex& other) { // complex * complex
-        Complex result;
-        result.real = this->real * other.real - this->imag * other.imag;
-        result.imag = this->imag * other.real + this->real * other.imag;
-        return result;
-    }
-
-    Complex operator+(const float& num) { // complex + float
-        return Complex(this->real + num, this->imag);
-    }
-    Complex operator-(const float& num) { // complex + float
-        return Complex(this->real - num, this->imag);
-    }
-    Complex operator*(const float& num) { // complex * float
-        return Complex(this->real * num, this->imag * num);
-    }
-    Complex operator/(const float& num) { // complex / float
-        return Complex(this->real / num, this->imag / num);
-    }
-    float lenSq() { // Calculate the squared length of complex
-        return (this->real * this->real + this->imag * this->imag);
-    }
-};
 struct ComplexPlane {
     Complex lu; // left up
     Complex ru; // right up
@@ -63,6 +46,39 @@ struct ComplexPlane {
     }
 };
 
+struct CheckpointHeader { // Identifies the render a checkpoint file belongs to
+    unsigned int magic;
+    int width;
+    int height;
+    int colorLevelMax;
+    int elemSize; // Bytes per count, see rawElemSize()
+    Complex planeLU;
+    Complex planeSize;
+    int kernelId;
+    Complex kernelParam;
+};
+struct Checkpoint { // Memory-mapped file: [header, completion bitmap, counts]
+    HANDLE file;
+    HANDLE mapping;
+    BYTE* view;
+    BYTE* doneMap; // 1 bit per column, only set once the column data is on disk
+    BYTE* countData; // Full-width counts, same layout as the raw file data: Column col is row col
+    int countDataSize;
+    BYTE* pendingMap; // Columns received since the last checkpoint
+    int pendingCount;
+};
+
+struct SlaveTask { // What the master knows about one slave
+    int col[QUEUE_DEPTH]; // Columns sent, in order. col[0] is being processed
+    bool speculative[QUEUE_DEPTH]; // col[i] is a copy of a late column
+    int colNum; // 0 if idle
+    LARGE_INTEGER start; // When col[0] was started
+    bool late; // col[0] has passed its deadline
+    int strikeCount; // # of columns a speculative copy finished first
+    bool blacklisted; // strikeCount reached BLACKLIST_LIMIT
+    bool stopped; // TAG_STOP has been sent
+};
+
 enum Tag {
     TAG_INFO,
     TAG_DATA,
@@ -70,8 +86,18 @@ enum Tag {
 };
 
 /* Function Declarition */
-int calculatePixel(Complex startPoint, float scaleW, int indexW, float scaleH, int indexH);
 int saveAsBmpFile(int w, int h, BYTE* pixelData); // Save pixelData as BMP to BMP_PATH
+int openCheckpoint(Checkpoint* ckpt, CheckpointHeader* header, bool restart); // Return # of completed columns, -1 on failure
+void markColumnDone(Checkpoint* ckpt, int col);
+bool isColumnDone(Checkpoint* ckpt, int col); // Received, whether checkpointed or not
+int nextMissingColumn(Checkpoint* ckpt, int col); // First column >= col not completed yet
+void saveCheckpoint(Checkpoint* ckpt); // Persist data then bitmap of the pending columns
+void closeCheckpoint(Checkpoint* ckpt, bool remove);
+void assignColumn(SlaveTask* slaves, int slaveNo, int col, bool speculative);
+void stopSlave(SlaveTask* slaves, int slaveNo);
+int countResponsiveSlaves(SlaveTask* slaves, int procNum, bool withBlacklisted); // Slaves neither stopped nor late
+bool isColumnLate(SlaveTask* slaves, int procNum, int col); // Every holder of col is late
+bool holdsColumn(SlaveTask* slave, int col);
 
 
 int main(int argc, char* argv[])
@@ -80,6 +106,7 @@ int main(int argc, char* argv[])
     Complex complexPlaneLU(-2.0, -2.0);
     Complex complexPlaneSize(4.0, 4.0);
     ComplexPlane complexPlane(complexPlaneLU, complexPlaneSize);
+    FractalKernel kernel;
 
     // Mapping scales
     float scaleW = complexPlaneSize.real / EDGE_PIXEL_NUM;
@@ -108,52 +135,251 @@ int main(int argc, char* argv[])
 
     if (myRank == 0) { // Master
 
+        // Checkpoint: Rows already received survive a crash and are skipped with "-restart"
+        bool restart = false;
+        for (int i = 1; i < argc; i ++) {
+            if (strcmp(argv[i], "-restart") == 0) {
+                restart = true;
+            }
+        }
+        CheckpointHeader ckptHeader;
+        ckptHeader.magic = CKPT_MAGIC;
+        ckptHeader.width = EDGE_PIXEL_NUM;
+        ckptHeader.height = EDGE_PIXEL_NUM;
+        ckptHeader.colorLevelMax = COLOR_LEVEL_MAX;
+        ckptHeader.elemSize = rawElemSize(COLOR_LEVEL_MAX);
+        ckptHeader.planeLU = complexPlaneLU;
+        ckptHeader.planeSize = complexPlaneSize;
+        ckptHeader.kernelId = FractalKernel::ID;
+        ckptHeader.kernelParam = kernel.param();
+
+        Checkpoint ckpt;
+        int doneCount = openCheckpoint(&ckpt, &ckptHeader, restart);
+        if (doneCount < 0) {
+            printf("ERROR: Cannot create checkpoint file %s.\n", CKPT_PATH);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+        if (restart) {
+            printf("Restart: %d of %d columns restored from %s.\n", doneCount, EDGE_PIXEL_NUM, CKPT_PATH);
+        }
         BYTE* bmpData = new BYTE[EDGE_PIXEL_NUM * EDGE_PIXEL_NUM];
-        
+        memset(bmpData, 0, EDGE_PIXEL_NUM * EDGE_PIXEL_NUM);
+
+        // Raw output: Each column task is 1 row of the raw image (indexH), written in place
+        RawImage raw;
+        if (rawCreate(&raw, RAW_PATH, EDGE_PIXEL_NUM, EDGE_PIXEL_NUM, COLOR_LEVEL_MAX,
+                      complexPlaneLU.real, complexPlaneLU.imag, complexPlaneSize.real, complexPlaneSize.imag,
+                      FractalKernel::ID, kernel.param().real, kernel.param().imag) != 0) {
+            printf("ERROR: Cannot create raw file %s.\n", RAW_PATH);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+        int elemSize = ckptHeader.elemSize;
+        for (int col = 0; col < EDGE_PIXEL_NUM; col ++) { // Columns restored from the checkpoint
+            if (isColumnDone(&ckpt, col)) {
+                BYTE* counts = ckpt.countData + (SIZE_T)col * EDGE_PIXEL_NUM * elemSize;
+                memcpy(rawRow(&raw, col), counts, EDGE_PIXEL_NUM * elemSize);
+                for (int i = 0; i < EDGE_PIXEL_NUM; i ++) {
+                    bmpData[i * EDGE_PIXEL_NUM + col] = rawLoadCount(counts + i * elemSize, elemSize);
+                }
+            }
+        }
+
+        LARGE_INTEGER ckptTime, nowTime;
+        QueryPerformanceCounter(&ckptTime);
+
         // Buffer preparation
-        int sendBuffer; // [colNo]
         int recvBuffer[EDGE_PIXEL_NUM + 1]; // [coordY, colors[EDGE_PIXEL_NUM]]
 
-        // Task assignment: Each PE will be assigned with [startColNo, endColNo) columns
-        int colCount = 0; // Columns being processing
-        int nextCol = 0; // Next column to be assigned
-        for (int i = 1; i < procNum && i < EDGE_PIXEL_NUM; i ++) { // First round assignment
-            sendBuffer = nextCol;
-            MPI_Send(&sendBuffer, 1, MPI_INT, i, TAG_INFO, MPI_COMM_WORLD);
-            colCount ++;
-            nextCol ++;
+        // Task tracking: Which slave holds which columns, so late columns can be re-issued
+        SlaveTask* slaves = new SlaveTask[procNum];
+        for (int i = 0; i < procNum; i ++) {
+            slaves[i].colNum = 0;
+            slaves[i].late = false;
+            slaves[i].strikeCount = 0;
+            slaves[i].blacklisted = false;
+            slaves[i].stopped = false;
         }
-
-        // Result collection
+        double* taskTimes = new double[EDGE_PIXEL_NUM]; // Of the accepted on-time columns, for the deadline
+        int taskTimeNum = 0;
+        double taskTimeLongest = 0.0; // Of all accepted columns, for the hang check
+
+        // Task assignment: Each PE holds up to QUEUE_DEPTH columns, the first round is done by the feeding below
+        int colCount = EDGE_PIXEL_NUM - doneCount; // Columns not received yet
+        int nextCol = nextMissingColumn(&ckpt, 0); // Next column to be assigned
+
+        // Result collection: Poll instead of blocking, so a hung slave cannot stall the master
+        double deadline = TASK_TIMEOUT_FIRST;
+        LARGE_INTEGER arrivalTime; // Of the last result
+        QueryPerformanceCounter(&arrivalTime);
         while (colCount > 0) {
-            MPI_Recv(recvBuffer, EDGE_PIXEL_NUM + 1, MPI_INT, MPI_ANY_SOURCE, TAG_DATA, MPI_COMM_WORLD, &status);
-            colCount --;
-
-            int slaveNo = status.MPI_SOURCE;
-            if (nextCol < EDGE_PIXEL_NUM) {
-                sendBuffer = nextCol;
-                MPI_Send(&sendBuffer, 1, MPI_INT, slaveNo, TAG_INFO, MPI_COMM_WORLD);
-                colCount ++;
-                nextCol ++;
-            } else {
-                sendBuffer = -1; // In case of wrong tag
-                MPI_Send(&sendBuffer, 1, MPI_INT, slaveNo, TAG_STOP, MPI_COMM_WORLD);
+            int arrived;
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_DATA, MPI_COMM_WORLD, &arrived, &status);
+            QueryPerformanceCounter(&nowTime);
+
+            if (arrived) {
+                int slaveNo = status.MPI_SOURCE;
+                MPI_Recv(recvBuffer, EDGE_PIXEL_NUM + 1, MPI_INT, slaveNo, TAG_DATA, MPI_COMM_WORLD, &status);
+                int col = recvBuffer[0]; // Always col[0]: Messages from 1 slave arrive in order
+                SlaveTask* slave = &slaves[slaveNo];
+                double taskTime = (double)(nowTime.QuadPart - slave->start.QuadPart) / (double)timeFreq.QuadPart;
+                bool onTime = !slave->late && !slave->speculative[0];
+                for (int i = 1; i < slave->colNum; i ++) { // Pop col[0], the next queued column starts now
+                    slave->col[i - 1] = slave->col[i];
+                    slave->speculative[i - 1] = slave->speculative[i];
+                }
+                slave->colNum --;
+                slave->start = nowTime;
+                slave->late = false;
+                arrivalTime = nowTime;
+
+                if (!isColumnDone(&ckpt, col)) { // First result wins, re-issued duplicates are discarded
+                    BYTE* counts = ckpt.countData + (SIZE_T)col * EDGE_PIXEL_NUM * elemSize;
+                    for (int i = 0; i < EDGE_PIXEL_NUM; i ++) {
+                        bmpData[i * EDGE_PIXEL_NUM + col] = recvBuffer[i + 1];
+                        rawStoreCount(counts + i * elemSize, elemSize, recvBuffer[i + 1]);
+                        rawSetPixel(&raw, i, col, recvBuffer[i + 1]);
+                    }
+                    markColumnDone(&ckpt, col);
+                    colCount --;
+
+                    // Column costs differ by orders of magnitude, so the deadline follows a high percentile.
+                    // Late and speculative results are left out, or a hung slave would stretch it for good
+                    if (taskTime > taskTimeLongest) {
+                        taskTimeLongest = taskTime;
+                    }
+                    if (onTime) {
+                        taskTimes[taskTimeNum ++] = taskTime;
+                        double* nth = taskTimes + (int)(TASK_TIME_PERCENTILE * (taskTimeNum - 1));
+                        std::nth_element(taskTimes, nth, taskTimes + taskTimeNum);
+                        deadline = TASK_TIMEOUT_FACTOR * *nth;
+                        if (deadline < TASK_TIMEOUT_MIN) {
+                            deadline = TASK_TIMEOUT_MIN;
+                        }
+                    }
+
+                    // Strike: An original holder still busy with col was beaten by its speculative copy
+                    for (int i = 1; i < procNum; i ++) {
+                        for (int j = 0; j < slaves[i].colNum; j ++) {
+                            if (slaves[i].col[j] == col && !slaves[i].speculative[j]) {
+                                slaves[i].strikeCount ++;
+                            }
+                        }
+                    }
+                }
+
+                // Blacklist: Not stopped, so it can still finish the job if every other slave hangs
+                if (slaves[slaveNo].strikeCount >= BLACKLIST_LIMIT && !slaves[slaveNo].blacklisted) {
+                    printf("WARNING: Slave %d was beaten %d times by a copy, only used when no other slave is in time.\n", slaveNo, slaves[slaveNo].strikeCount);
+                    slaves[slaveNo].blacklisted = true;
+                }
+
+                // Checkpoint at most once per CKPT_INTERVAL, so flushing stays a small part of the runtime
+                if ((double)(nowTime.QuadPart - ckptTime.QuadPart) / (double)timeFreq.QuadPart >= CKPT_INTERVAL) {
+                    saveCheckpoint(&ckpt);
+                    ckptTime = nowTime;
+                }
+            } else if ((double)(nowTime.QuadPart - arrivalTime.QuadPart) / (double)timeFreq.QuadPart > POLL_SPIN) {
+                Sleep(POLL_INTERVAL); // Leave the CPU to slaves sharing this node, their queues keep them busy
+            }
+
+            // Deadlines: TASK_TIMEOUT_FIRST until a column has been measured, so a slave hung from the start is caught too
+            for (int i = 1; i < procNum; i ++) {
+                if (slaves[i].colNum > 0 && !slaves[i].late
+                    && (double)(nowTime.QuadPart - slaves[i].start.QuadPart) / (double)timeFreq.QuadPart > deadline) {
+                    slaves[i].late = true;
+                }
+            }
+
+            // Hang: Never before the longest column seen, which the deadline may leave out
+            double silence = (double)(nowTime.QuadPart - arrivalTime.QuadPart) / (double)timeFreq.QuadPart;
+            double hangTimeout = HANG_TIMEOUT_FACTOR * (deadline > taskTimeLongest ? deadline : taskTimeLongest);
+            if (countResponsiveSlaves(slaves, procNum, true) == 0 && silence > hangTimeout) {
+                saveCheckpoint(&ckpt);
+                printf("ERROR: Every slave is late and none answered for %fs, abort. Rerun with -restart to resume from %s.\n", silence, CKPT_PATH);
+                MPI_Abort(MPI_COMM_WORLD, -1);
+            }
+
+            // Feed slaves: New columns level by level to keep the queues even, never behind a late column
+            bool useBlacklisted = countResponsiveSlaves(slaves, procNum, false) == 0;
+            for (int depth = 0; depth < QUEUE_DEPTH && nextCol < EDGE_PIXEL_NUM; depth ++) {
+                for (int i = 1; i < procNum && nextCol < EDGE_PIXEL_NUM; i ++) {
+                    if (slaves[i].colNum != depth || slaves[i].late || slaves[i].stopped || (slaves[i].blacklisted && !useBlacklisted)) {
+                        continue;
+                    }
+                    assignColumn(slaves, i, nextCol, false);
+                    nextCol = nextMissingColumn(&ckpt, nextCol + 1);
+                }
             }
 
-            // Read recvBuffer
-            for (int i = 0; i < EDGE_PIXEL_NUM; i ++) {
-                bmpData[i * EDGE_PIXEL_NUM + recvBuffer[0]] = recvBuffer[i + 1];
+            // Then idle slaves get a speculative copy of a column whose holders are all late
+            for (int i = 1; i < procNum && nextCol >= EDGE_PIXEL_NUM; i ++) {
+                if (slaves[i].colNum > 0 || slaves[i].stopped || (slaves[i].blacklisted && !useBlacklisted)) {
+                    continue;
+                }
+                int lateCol = -1;
+                for (int j = 1; j < procNum && lateCol < 0; j ++) {
+                    for (int k = 0; k < slaves[j].colNum && lateCol < 0; k ++) {
+                        int col = slaves[j].col[k];
+                        if (!isColumnDone(&ckpt, col) && isColumnLate(slaves, procNum, col)) {
+                            lateCol = col;
+                        }
+                    }
+                }
+                if (lateCol < 0) {
+                    break; // Every outstanding column has a holder in time
+                }
+                assignColumn(slaves, i, lateCol, true);
             }
         }
 
         // BMP generation & Memory Releas
         saveAsBmpFile(EDGE_PIXEL_NUM, EDGE_PIXEL_NUM, bmpData);
+        closeCheckpoint(&ckpt, true);
+        rawClose(&raw);
         delete[]bmpData;
 
         QueryPerformanceCounter(&timeEnd);
         double timeDiff = (double)(timeEnd.QuadPart - timeStart.QuadPart) / (double)timeFreq.QuadPart;
         printf("Dynamic[%d Slave(s)]: Run for %fs.\n", procNum - 1, timeDiff);
 
+        // Stop the idle slaves, give the busy ones 1 more deadline to hand in their duplicates
+        int busyNum = 0;
+        for (int i = 1; i < procNum; i ++) {
+            if (slaves[i].colNum > 0) {
+                busyNum ++;
+            } else if (!slaves[i].stopped) {
+                stopSlave(slaves, i);
+            }
+        }
+        LARGE_INTEGER drainStart;
+        QueryPerformanceCounter(&drainStart);
+        while (busyNum > 0) {
+            int arrived;
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_DATA, MPI_COMM_WORLD, &arrived, &status);
+            if (arrived) {
+                int slaveNo = status.MPI_SOURCE;
+                MPI_Recv(recvBuffer, EDGE_PIXEL_NUM + 1, MPI_INT, slaveNo, TAG_DATA, MPI_COMM_WORLD, &status);
+                slaves[slaveNo].colNum --;
+                if (slaves[slaveNo].colNum == 0) {
+                    stopSlave(slaves, slaveNo);
+                    busyNum --;
+                }
+                continue;
+            }
+            QueryPerformanceCounter(&nowTime);
+            if ((double)(nowTime.QuadPart - drainStart.QuadPart) / (double)timeFreq.QuadPart > deadline) {
+                break;
+            }
+            Sleep(POLL_INTERVAL);
+        }
+        delete[]slaves;
+        delete[]taskTimes;
+
+        if (busyNum > 0) { // A hung slave would block MPI_Finalize forever
+            printf("WARNING: %d slave(s) not responding, abort. The BMP and raw file are complete.\n", busyNum);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
     } else { // Slaves
         
         // Buffer preparation
@@ -169,7 +395,7 @@ int main(int argc, char* argv[])
             if (status.MPI_TAG == TAG_INFO) {
                 sendBuffer[0] = recvBuffer;
                 for (int i = 0; i < EDGE_PIXEL_NUM; i ++) {
-                    sendBuffer[i+1] = calculatePixel(complexPlane.lu, scaleW, i, scaleH, recvBuffer);
+                    sendBuffer[i+1] = calculatePixel(kernel, complexPlane.lu, scaleW, i, scaleH, recvBuffer, COLOR_LEVEL_MAX);
                 }
 
                 MPI_Send(sendBuffer, EDGE_PIXEL_NUM + 1, MPI_INT, 0, TAG_DATA, MPI_COMM_WORLD);
@@ -187,20 +413,170 @@ int main(int argc, char* argv[])
     return 0;
 }
 
-int calculatePixel(Complex planeOrigin, float scaleW, int indexW, float scaleH, int indexH) {
-    Complex offset(scaleW * indexW, scaleH * indexH);
-    Complex c = planeOrigin + offset; // Mapping
+/* Checkpoint of the columns received by the master */
 
-    int count = 0;
-    Complex z(0.0, 0.0);
-    do {
-        z = z * z + c;
-        count ++;
-    } while (z.lenSq() < 4.0 && count < COLOR_LEVEL_MAX);
+int openCheckpoint(Checkpoint* ckpt, CheckpointHeader* header, bool restart) {
+    int mapSize = EDGE_PIXEL_NUM / 8 + 1;
+    ckpt->countDataSize = EDGE_PIXEL_NUM * EDGE_PIXEL_NUM * header->elemSize;
+    int fileSize = sizeof(CheckpointHeader) + mapSize + ckpt->countDataSize;
+
+    ckpt->view = NULL;
+    ckpt->mapping = NULL;
+    ckpt->pendingMap = new BYTE[mapSize];
+    memset(ckpt->pendingMap, 0, mapSize);
+    ckpt->pendingCount = 0;
+
+    // Reuse the old file only if it was written for the same render
+    bool resume = false;
+    ckpt->file = CreateFileA(CKPT_PATH, GENERIC_READ | GENERIC_WRITE, 0, NULL, restart ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (ckpt->file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    LARGE_INTEGER oldSize;
+    if (restart && GetFileSizeEx(ckpt->file, &oldSize) && oldSize.QuadPart == fileSize) {
+        resume = true;
+    }
+    if (!resume) { // A stale file of another size: Cut it, or the next -restart would see a wrong size
+        LARGE_INTEGER newSize;
+        newSize.QuadPart = fileSize;
+        if (!SetFilePointerEx(ckpt->file, newSize, NULL, FILE_BEGIN) || !SetEndOfFile(ckpt->file)) {
+            closeCheckpoint(ckpt, false);
+            return -1;
+        }
+    }
+
+    ckpt->mapping = CreateFileMappingA(ckpt->file, NULL, PAGE_READWRITE, 0, fileSize, NULL);
+    if (ckpt->mapping != NULL) {
+        ckpt->view = (BYTE*)MapViewOfFile(ckpt->mapping, FILE_MAP_WRITE, 0, 0, fileSize);
+    }
+    if (ckpt->view == NULL) {
+        closeCheckpoint(ckpt, false);
+        return -1;
+    }
+    ckpt->doneMap = ckpt->view + sizeof(CheckpointHeader);
+    ckpt->countData = ckpt->doneMap + mapSize;
+
+    if (resume && memcmp(ckpt->view, header, sizeof(CheckpointHeader)) != 0) {
+        printf("WARNING: %s belongs to another render, start from scratch.\n", CKPT_PATH);
+        resume = false;
+    }
+    if (!resume) { // Fresh file: No column is done yet
+        memset(ckpt->view, 0, fileSize);
+        memcpy(ckpt->view, header, sizeof(CheckpointHeader));
+        FlushViewOfFile(ckpt->view, 0);
+        FlushFileBuffers(ckpt->file);
+        return 0;
+    }
+
+    int doneCount = 0;
+    for (int i = 0; i < EDGE_PIXEL_NUM; i ++) {
+        if (ckpt->doneMap[i / 8] & (1 << (i % 8))) {
+            doneCount ++;
+        }
+    }
+    return doneCount;
+}
+
+void markColumnDone(Checkpoint* ckpt, int col) {
+    ckpt->pendingMap[col / 8] |= 1 << (col % 8);
+    ckpt->pendingCount ++;
+}
+
+bool isColumnDone(Checkpoint* ckpt, int col) {
+    return ((ckpt->doneMap[col / 8] | ckpt->pendingMap[col / 8]) & (1 << (col % 8))) != 0;
+}
+
+int nextMissingColumn(Checkpoint* ckpt, int col) {
+    while (col < EDGE_PIXEL_NUM && isColumnDone(ckpt, col)) {
+        col ++;
+    }
+    return col;
+}
+
+void saveCheckpoint(Checkpoint* ckpt) {
+    if (ckpt->pendingCount == 0) {
+        return;
+    }
+
+    // Counts must reach the disk before the bits claiming they are there
+    FlushViewOfFile(ckpt->countData, ckpt->countDataSize);
+    FlushFileBuffers(ckpt->file);
 
+    int mapSize = EDGE_PIXEL_NUM / 8 + 1;
+    for (int i = 0; i < mapSize; i ++) {
+        ckpt->doneMap[i] |= ckpt->pendingMap[i];
+        ckpt->pendingMap[i] = 0;
+    }
+    ckpt->pendingCount = 0;
+    FlushViewOfFile(ckpt->doneMap, mapSize);
+    FlushFileBuffers(ckpt->file);
+}
+
+void closeCheckpoint(Checkpoint* ckpt, bool remove) {
+    if (ckpt->view != NULL) {
+        UnmapViewOfFile(ckpt->view);
+    }
+    if (ckpt->mapping != NULL) {
+        CloseHandle(ckpt->mapping);
+    }
+    CloseHandle(ckpt->file);
+    delete[]ckpt->pendingMap;
+
+    if (remove) {
+        DeleteFileA(CKPT_PATH);
+    }
+}
+
+/* Task tracking of the slaves */
+
+void assignColumn(SlaveTask* slaves, int slaveNo, int col, bool speculative) {
+    int sendBuffer = col; // [colNo]
+    MPI_Send(&sendBuffer, 1, MPI_INT, slaveNo, TAG_INFO, MPI_COMM_WORLD);
+
+    SlaveTask* slave = &slaves[slaveNo];
+    if (slave->colNum == 0) { // Starts right away, otherwise when the column ahead is received
+        QueryPerformanceCounter(&slave->start);
+        slave->late = false;
+    }
+    slave->col[slave->colNum] = col;
+    slave->speculative[slave->colNum] = speculative;
+    slave->colNum ++;
+}
+
+void stopSlave(SlaveTask* slaves, int slaveNo) {
+    int sendBuffer = -1; // In case of wrong tag
+    MPI_Send(&sendBuffer, 1, MPI_INT, slaveNo, TAG_STOP, MPI_COMM_WORLD);
+    slaves[slaveNo].stopped = true;
+}
+
+int countResponsiveSlaves(SlaveTask* slaves, int procNum, bool withBlacklisted) {
+    int count = 0;
+    for (int i = 1; i < procNum; i ++) {
+        if (!slaves[i].stopped && !slaves[i].late && (withBlacklisted || !slaves[i].blacklisted)) {
+            count ++;
+        }
+    }
     return count;
 }
 
+bool isColumnLate(SlaveTask* slaves, int procNum, int col) { // Queued behind a late column counts as late
+    for (int i = 1; i < procNum; i ++) {
+        if (holdsColumn(&slaves[i], col) && !slaves[i].late) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool holdsColumn(SlaveTask* slave, int col) {
+    for (int i = 0; i < slave->colNum; i ++) {
+        if (slave->col[i] == col) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Generate grayscale BMP file from pixel data */
 
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
@@ -0,0 +1,145 @@
+#pragma once
+
+/* Escape-time kernels shared by the Sequential, Static and Dynamic methods
+ * The kernel is a template parameter of calculatePixel, so each formula is inlined into the loop.
+ */
+
+#include <math.h>
+
+struct Complex { // Define complex number with some operations
+    float real;
+    float imag;
+
+    Complex() : real(0.0), imag(0.0) {}
+    Complex(float r, float i) : real(r), imag(i) {}
+
+    Complex operator+(const Complex& other) { // complex + complex
+        return Complex(this->real + other.real, this->imag + other.imag);
+    }
+    Complex operator-(const Complex& other) { // complex - complex
+        return Complex(this->real - other.real, this->imag - other.imag);
+    }
+    Complex operator*(const Complex& other) { // complex * complex
+        Complex result;
+        result.real = this->real * other.real - this->imag * other.imag;
+        result.imag = this->imag * other.real + this->real * other.imag;
+        return result;
+    }
+
+    Complex operator+(const float& num) { // complex + float
+        return Complex(this->real + num, this->imag);
+    }
+    Complex operator-(const float& num) { // complex + float
+        return Complex(this->real - num, this->imag);
+    }
+    Complex operator*(const float& num) { // complex * float
+        return Complex(this->real * num, this->imag * num);
+    }
+    Complex operator/(const float& num) { // complex / float
+        return Complex(this->real / num, this->imag / num);
+    }
+    Complex sq() { // complex * itself, 1 multiplication less
+        return Complex(this->real * this->real - this->imag * this->imag, 2 * this->real * this->imag);
+    }
+    float lenSq() { // Calculate the squared length of complex
+        return (this->real * this->real + this->imag * this->imag);
+    }
+};
+
+enum KernelId { // Tells renders of different kernels apart, e.g. in checkpoints
+    KERNEL_MANDELBROT,
+    KERNEL_JULIA,
+    KERNEL_BURNING_SHIP,
+    KERNEL_MULTIBROT // + power
+};
+
+/* z^D by squaring, unrolled at compile time */
+template <int D>
+struct Power {
+    static Complex of(Complex z) {
+        Complex half = Power<D / 2>::of(z);
+        return D % 2 == 0 ? half.sq() : half.sq() * z;
+    }
+};
+template <>
+struct Power<1> {
+    static Complex of(Complex z) { return z; }
+};
+
+/* Kernels: init() maps a pixel to (z0, c), iterate() does 1 step */
+
+struct MandelbrotKernel { // z = z^2 + c, z0 = 0
+    static const int ID = KERNEL_MANDELBROT;
+
+    Complex param() const { return Complex(); }
+    void init(Complex point, Complex& z, Complex& c) const {
+        z = Complex(0.0, 0.0);
+        c = point;
+    }
+    Complex iterate(Complex z, Complex c) const {
+        return z * z + c;
+    }
+};
+
+struct JuliaKernel { // z = z^2 + c with a fixed c, z0 = pixel
+    static const int ID = KERNEL_JULIA;
+    Complex constant;
+
+    JuliaKernel() : constant(-0.8f, 0.156f) {}
+    JuliaKernel(Complex c) : constant(c) {}
+
+    Complex param() const { return constant; }
+    void init(Complex point, Complex& z, Complex& c) const {
+        z = point;
+        c = constant;
+    }
+    Complex iterate(Complex z, Complex c) const {
+        return z.sq() + c;
+    }
+};
+
+template <int D>
+struct MultibrotKernel { // z = z^D + c, z0 = 0
+    static_assert(D >= 2, "Multibrot power should be >= 2");
+    static const int ID = KERNEL_MULTIBROT + D;
+
+    Complex param() const { return Complex(); }
+    void init(Complex point, Complex& z, Complex& c) const {
+        z = Complex(0.0, 0.0);
+        c = point;
+    }
+    Complex iterate(Complex z, Complex c) const {
+        return Power<D>::of(z) + c;
+    }
+};
+
+struct BurningShipKernel { // z = (|Re z| + i|Im z|)^2 + c, z0 = 0
+    static const int ID = KERNEL_BURNING_SHIP;
+
+    Complex param() const { return Complex(); }
+    void init(Complex point, Complex& z, Complex& c) const {
+        z = Complex(0.0, 0.0);
+        c = point;
+    }
+    Complex iterate(Complex z, Complex c) const {
+        return Complex(fabsf(z.real), fabsf(z.imag)).sq() + c;
+    }
+};
+
+/* Iteration count of pixel (indexW, indexH), at most maxIter */
+template <class Kernel>
+inline int calculatePixel(const Kernel& kernel, Complex planeOrigin, float scaleW, int indexW, float scaleH, int indexH, int maxIter) {
+    Complex offset(scaleW * indexW, scaleH * indexH);
+    Complex point = planeOrigin + offset; // Mapping
+
+    Complex z, c;
+    kernel.init(point, z, c);
+
+    int count = 0;
+    do {
+        z = kernel.iterate(z, c);
+        count ++;
+    } while (z.lenSq() < 4.0 && count < maxIter);
+
+    return count;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+/* Raw iteration-count image: [RawHeader, counts row by row]
+ * Written in place through a memory-mapped file, read back by mapping only the rows needed.
+ */
+
+#include <string.h>
+#include <windows.h>
+
+#define RAW_MAGIC 0x5741524D // "MRAW"
+#define RAW_VERSION 2 // 2: Kernel id and parameter
+
+struct RawHeader {
+    unsigned int magic;
+    unsigned int version;
+    int width;
+    int height;
+    int elemSize; // Bytes per count: 1, 2 or 4
+    int maxIter;
+    float viewLUReal; // Complex coord of pixel (0, 0)
+    float viewLUImag;
+    float viewSizeReal; // Complex size covered by the whole image
+    float viewSizeImag;
+    int dataOffset; // Where row 0 starts
+    int kernelId; // FractalKernel::ID, see Fractal.h
+    float kernelParamReal; // kernel.param(), e.g. the Julia constant
+    float kernelParamImag;
+    int reserved;
+};
+struct RawImage {
+    HANDLE file;
+    HANDLE mapping;
+    BYTE* view;
+    RawHeader header; // Copy, valid after rawCreate / rawOpen
+    BYTE* data; // Writers only: All rows, mapped read-write
+};
+
+inline int rawElemSize(int maxIter) { // Smallest width holding every count
+    if (maxIter <= 0xFF) {
+        return 1;
+    }
+    if (maxIter <= 0xFFFF) {
+        return 2;
+    }
+    return 4;
+}
+
+inline void rawClose(RawImage* raw) {
+    if (raw->view != NULL) {
+        FlushViewOfFile(raw->view, 0);
+        UnmapViewOfFile(raw->view);
+    }
+    if (raw->mapping != NULL) {
+        CloseHandle(raw->mapping);
+    }
+    if (raw->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(raw->file);
+    }
+    raw->view = NULL;
+    raw->mapping = NULL;
+    raw->file = INVALID_HANDLE_VALUE;
+    raw->data = NULL;
+}
+
+/* Writer */
+
+inline int rawCreate(RawImage* raw, const char* path, int w, int h, int maxIter,
+                     float luReal, float luImag, float sizeReal, float sizeImag,
+                     int kernelId, float paramReal, float paramImag) { // Return 0, -1 on failure
+    RawHeader* header = &raw->header;
+    memset(header, 0, sizeof(RawHeader));
+    header->magic = RAW_MAGIC;
+    header->version = RAW_VERSION;
+    header->width = w;
+    header->height = h;
+    header->elemSize = rawElemSize(maxIter);
+    header->maxIter = maxIter;
+    header->viewLUReal = luReal;
+    header->viewLUImag = luImag;
+    header->viewSizeReal = sizeReal;
+    header->viewSizeImag = sizeImag;
+    header->dataOffset = sizeof(RawHeader);
+    header->kernelId = kernelId;
+    header->kernelParamReal = paramReal;
+    header->kernelParamImag = paramImag;
+
+    ULONGLONG fileSize = header->dataOffset + (ULONGLONG)w * h * header->elemSize;
+    raw->view = NULL;
+    raw->mapping = NULL;
+    raw->data = NULL;
+    raw->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (raw->file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    raw->mapping = CreateFileMappingA(raw->file, NULL, PAGE_READWRITE, (DWORD)(fileSize >> 32), (DWORD)fileSize, NULL);
+    if (raw->mapping != NULL) {
+        raw->view = (BYTE*)MapViewOfFile(raw->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)fileSize);
+    }
+    if (raw->view == NULL) {
+        rawClose(raw);
+        return -1;
+    }
+
+    memcpy(raw->view, header, sizeof(RawHeader));
+    raw->data = raw->view + header->dataOffset;
+    return 0;
+}
+
+inline BYTE* rawRow(RawImage* raw, int y) { // Writers only
+    return raw->data + (SIZE_T)y * raw->header.width * raw->header.elemSize;
+}
+
+inline void rawStoreCount(BYTE* p, int elemSize, unsigned int count) { // Also for other buffers in the raw layout
+    switch (elemSize) {
+    case 1: *p = (BYTE)count; break;
+    case 2: *(unsigned short*)p = (unsigned short)count; break;
+    default: *(unsigned int*)p = count; break;
+    }
+}
+
+inline unsigned int rawLoadCount(const BYTE* p, int elemSize) {
+    switch (elemSize) {
+    case 1: return *p;
+    case 2: return *(const unsigned short*)p;
+    default: return *(const unsigned int*)p;
+    }
+}
+
+inline void rawSetPixel(RawImage* raw, int x, int y, unsigned int count) { // Writers only
+    rawStoreCount(rawRow(raw, y) + (SIZE_T)x * raw->header.elemSize, raw->header.elemSize, count);
+}
+
+/* Reader: Maps the header, then only the rows of each requested rectangle */
+
+inline int rawOpen(RawImage* raw, const char* path) { // Return 0, -1 on failure
+    raw->view = NULL;
+    raw->mapping = NULL;
+    raw->data = NULL;
+    raw->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (raw->file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    LARGE_INTEGER fileSize;
+    raw->mapping = CreateFileMappingA(raw->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (raw->mapping == NULL || !GetFileSizeEx(raw->file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(RawHeader)) {
+        rawClose(raw);
+        return -1;
+    }
+
+    const BYTE* headerView = (const BYTE*)MapViewOfFile(raw->mapping, FILE_MAP_READ, 0, 0, sizeof(RawHeader));
+    if (headerView == NULL) {
+        rawClose(raw);
+        return -1;
+    }
+    memcpy(&raw->header, headerView, sizeof(RawHeader));
+    UnmapViewOfFile(headerView);
+
+    RawHeader* header = &raw->header;
+    bool valid = header->magic == RAW_MAGIC && header->version == RAW_VERSION
+        && header->width > 0 && header->height > 0
+        && (header->elemSize == 1 || header->elemSize == 2 || header->elemSize == 4)
+        && header->maxIter > 0 && header->dataOffset >= (int)sizeof(RawHeader)
+        && fileSize.QuadPart >= header->dataOffset + (LONGLONG)header->width * header->height * header->elemSize;
+    if (!valid) {
+        rawClose(raw);
+        return -1;
+    }
+    return 0;
+}
+
+/* Copy the w x h counts at (x, y) to out, row by row. Return 0, -1 if out of the image */
+inline int rawReadRect(RawImage* raw, int x, int y, int w, int h, unsigned int* out) {
+    RawHeader* header = &raw->header;
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > header->width || y + h > header->height) {
+        return -1;
+    }
+
+    // Views must start at a multiple of the allocation granularity
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    SIZE_T rowSize = (SIZE_T)header->width * header->elemSize;
+    ULONGLONG first = header->dataOffset + (ULONGLONG)y * rowSize + (ULONGLONG)x * header->elemSize;
+    ULONGLONG last = header->dataOffset + (ULONGLONG)(y + h - 1) * rowSize + (ULONGLONG)(x + w) * header->elemSize;
+    ULONGLONG viewStart = first - first % sysInfo.dwAllocationGranularity;
+
+    const BYTE* view = (const BYTE*)MapViewOfFile(raw->mapping, FILE_MAP_READ,
+        (DWORD)(viewStart >> 32), (DWORD)viewStart, (SIZE_T)(last - viewStart));
+    if (view == NULL) {
+        return -1;
+    }
+
+    const BYTE* row = view + (first - viewStart);
+    for (int j = 0; j < h; j ++, row += rowSize) {
+        unsigned int* outRow = out + (SIZE_T)j * w;
+        switch (header->elemSize) {
+        case 1:
+            for (int i = 0; i < w; i ++) {
+                outRow[i] = row[i];
+            }
+            break;
+        case 2:
+            for (int i = 0; i < w; i ++) {
+                outRow[i] = ((const unsigned short*)row)[i];
+            }
+            break;
+        default:
+            memcpy(outRow, row, w * sizeof(unsigned int));
+            break;
+        }
+    }
+
+    UnmapViewOfFile(view);
+    return 0;
+}
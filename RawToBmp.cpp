@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include "RawImage.h"
+
+#define BAND_ROWS 64 // Rows read from the raw file at a time
+#define DEFLATE_STORED_MAX 65535 // Max bytes of a stored deflate block
+
+/* Function Declarition */
+int saveAsBmpStream(RawImage* raw, FILE* out);
+int saveAsPngStream(RawImage* raw, FILE* out);
+void countsToGray(RawImage* raw, unsigned int* counts, int n, BYTE* gray);
+unsigned int crc32Update(unsigned int crc, const BYTE* data, int n);
+void putBigEndian(BYTE* p, unsigned int v);
+void writePngChunk(FILE* out, const char* type, const BYTE* data, int n);
+
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        printf("Usage: RawToBmp.exe <input.raw> <output.bmp|output.png>\n");
+        exit(-1);
+    }
+
+    RawImage raw;
+    if (rawOpen(&raw, argv[1]) != 0) {
+        printf("ERROR: %s is not a valid raw iteration-count file.\n", argv[1]);
+        exit(-1);
+    }
+    FILE* out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        printf("ERROR: Cannot create %s.\n", argv[2]);
+        rawClose(&raw);
+        exit(-1);
+    }
+
+    const char* ext = strrchr(argv[2], '.');
+    int stat;
+    if (ext != NULL && _stricmp(ext, ".png") == 0) {
+        stat = saveAsPngStream(&raw, out);
+    } else {
+        stat = saveAsBmpStream(&raw, out);
+    }
+    if (ferror(out)) { // Any failed fwrite
+        stat = -1;
+    }
+    if (fclose(out) != 0) {
+        stat = -1;
+    }
+    rawClose(&raw);
+
+    if (stat != 0) { // Never leave a truncated image with a valid-looking header
+        remove(argv[2]);
+        printf("Failure: Cannot convert %s to %s.\n", argv[1], argv[2]);
+        return -1;
+    }
+    printf("%dx%d image was generated at: %s\n", raw.header.width, raw.header.height, argv[2]);
+    return 0;
+}
+
+void countsToGray(RawImage* raw, unsigned int* counts, int n, BYTE* gray) {
+    unsigned int maxIter = raw->header.maxIter > 0 ? raw->header.maxIter : 1;
+    for (int i = 0; i < n; i ++) {
+        unsigned int count = counts[i] < maxIter ? counts[i] : maxIter;
+        gray[i] = (BYTE)((unsigned long long)count * 255 / maxIter);
+    }
+}
+
+/* Grayscale BMP: Rows are stored bottom-up, so bands are read from the bottom */
+
+int saveAsBmpStream(RawImage* raw, FILE* out) {
+    int w = raw->header.width;
+    int h = raw->header.height;
+    int stride = (w + 3) & ~3; // Rows are padded to 4 bytes
+
+    BITMAPFILEHEADER fileHeader;
+    BITMAPINFOHEADER infoHeader;
+    RGBQUAD palette[256];
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    memset(&infoHeader, 0, sizeof(infoHeader));
+    fileHeader.bfType = 0x4D42; // "BM"
+    fileHeader.bfOffBits = sizeof(fileHeader) + sizeof(infoHeader) + sizeof(palette);
+    fileHeader.bfSize = fileHeader.bfOffBits + stride * h;
+    infoHeader.biSize = sizeof(infoHeader);
+    infoHeader.biWidth = w;
+    infoHeader.biHeight = h;
+    infoHeader.biPlanes = 1;
+    infoHeader.biBitCount = 8;
+    infoHeader.biCompression = BI_RGB;
+    infoHeader.biSizeImage = stride * h;
+    infoHeader.biClrUsed = 256;
+    for (int i = 0; i < 256; i ++) {
+        palette[i].rgbBlue = palette[i].rgbGreen = palette[i].rgbRed = i;
+        palette[i].rgbReserved = 0;
+    }
+    fwrite(&fileHeader, sizeof(fileHeader), 1, out);
+    fwrite(&infoHeader, sizeof(infoHeader), 1, out);
+    fwrite(palette, sizeof(palette), 1, out);
+
+    unsigned int* counts = new unsigned int[BAND_ROWS * w];
+    BYTE* gray = new BYTE[stride];
+    memset(gray, 0, stride);
+    int stat = 0;
+    for (int bandEnd = h; bandEnd > 0 && stat == 0; bandEnd -= BAND_ROWS) {
+        int bandStart = bandEnd > BAND_ROWS ? bandEnd - BAND_ROWS : 0;
+        stat = rawReadRect(raw, 0, bandStart, w, bandEnd - bandStart, counts);
+        for (int y = bandEnd - 1; y >= bandStart && stat == 0; y --) {
+            countsToGray(raw, counts + (y - bandStart) * w, w, gray);
+            fwrite(gray, 1, stride, out);
+        }
+        if (stat == 0 && ferror(out)) {
+            stat = -1;
+        }
+    }
+    delete[]counts;
+    delete[]gray;
+
+    return stat;
+}
+
+/* Grayscale PNG: One IDAT chunk per band, holding uncompressed (stored) deflate blocks */
+
+unsigned int crc32Update(unsigned int crc, const BYTE* data, int n) {
+    static unsigned int table[256];
+    if (table[1] == 0) {
+        for (unsigned int i = 0; i < 256; i ++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k ++) {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+    for (int i = 0; i < n; i ++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void putBigEndian(BYTE* p, unsigned int v) {
+    p[0] = (BYTE)(v >> 24);
+    p[1] = (BYTE)(v >> 16);
+    p[2] = (BYTE)(v >> 8);
+    p[3] = (BYTE)v;
+}
+
+void writePngChunk(FILE* out, const char* type, const BYTE* data, int n) {
+    BYTE buf[4];
+    putBigEndian(buf, n);
+    fwrite(buf, 1, 4, out);
+    fwrite(type, 1, 4, out);
+    fwrite(data, 1, n, out);
+    unsigned int crc = crc32Update(0xFFFFFFFF, (const BYTE*)type, 4);
+    crc = crc32Update(crc, data, n) ^ 0xFFFFFFFF;
+    putBigEndian(buf, crc);
+    fwrite(buf, 1, 4, out);
+}
+
+int saveAsPngStream(RawImage* raw, FILE* out) {
+    int w = raw->header.width;
+    int h = raw->header.height;
+    int lineSize = w + 1; // [filter type, gray[w]]
+
+    static const BYTE signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, out);
+    BYTE ihdr[13];
+    putBigEndian(ihdr, w);
+    putBigEndian(ihdr + 4, h);
+    ihdr[8] = 8; // Bit depth
+    ihdr[9] = 0; // Grayscale
+    ihdr[10] = ihdr[11] = ihdr[12] = 0; // Deflate, no filter, no interlace
+    writePngChunk(out, "IHDR", ihdr, 13);
+
+    int bandSize = BAND_ROWS * lineSize;
+    int blockNum = (bandSize + DEFLATE_STORED_MAX - 1) / DEFLATE_STORED_MAX;
+    unsigned int* counts = new unsigned int[BAND_ROWS * w];
+    BYTE* lines = new BYTE[bandSize];
+    BYTE* idat = new BYTE[2 + bandSize + blockNum * 5 + 4]; // [zlib header, blocks, adler32]
+    unsigned int adlerA = 1, adlerB = 0;
+    int stat = 0;
+    for (int bandStart = 0; bandStart < h && stat == 0; bandStart += BAND_ROWS) {
+        int rows = h - bandStart < BAND_ROWS ? h - bandStart : BAND_ROWS;
+        stat = rawReadRect(raw, 0, bandStart, w, rows, counts);
+        if (stat != 0) {
+            break;
+        }
+        for (int y = 0; y < rows; y ++) {
+            lines[y * lineSize] = 0; // Filter: None
+            countsToGray(raw, counts + y * w, w, lines + y * lineSize + 1);
+        }
+
+        int n = 0;
+        if (bandStart == 0) {
+            idat[n ++] = 0x78; // zlib: Deflate, 32K window
+            idat[n ++] = 0x01;
+        }
+        bool lastBand = bandStart + rows >= h;
+        int left = rows * lineSize;
+        for (const BYTE* p = lines; left > 0; ) {
+            int len = left < DEFLATE_STORED_MAX ? left : DEFLATE_STORED_MAX;
+            idat[n ++] = lastBand && len == left ? 1 : 0; // BFINAL, BTYPE = stored
+            idat[n ++] = (BYTE)len;
+            idat[n ++] = (BYTE)(len >> 8);
+            idat[n ++] = (BYTE)~len;
+            idat[n ++] = (BYTE)(~len >> 8);
+            memcpy(idat + n, p, len);
+            n += len;
+            p += len;
+            left -= len;
+        }
+        for (int i = 0; i < rows * lineSize; i ++) {
+            adlerA = (adlerA + lines[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        if (lastBand) {
+            putBigEndian(idat + n, (adlerB << 16) | adlerA);
+            n += 4;
+        }
+        writePngChunk(out, "IDAT", idat, n);
+        if (ferror(out)) {
+            stat = -1;
+        }
+    }
+    writePngChunk(out, "IEND", NULL, 0);
+    delete[]counts;
+    delete[]lines;
+    delete[]idat;
+
+    return stat;
+}
@@ -6,49 +6,18 @@
 #include <direct.h> // Get cwd
 #include <gdiplus.h>
 #include "mpi.h"
+#include "RawImage.h"
+#include "Fractal.h"
 
 using namespace Gdiplus;
 
 #define EDGE_PIXEL_NUM 400 // Aka. display_width
 #define COLOR_LEVEL_MAX 255
 #define BMP_PATH L"DemoMPI.bmp"
+#define RAW_PATH "Mandelbrot.raw" // Iteration counts, see RawImage.h
 
-struct Complex { // Define complex number with some operations
-    float real;
-    float imag;
+typedef MandelbrotKernel FractalKernel; // Or JuliaKernel, MultibrotKernel<3>, BurningShipKernel
 
-    Complex() : real(0.0), imag(0.0) {}
-    Complex(float r, float i) : real(r), imag(i) {}
-
-    Complex operator+(const Complex& other) { // complex + complex
-        return Complex(this->real + other.real, this->imag + other.imag);
-    }
-    Complex operator-(const Complex& other) { // complex - complex
-        return Complex(this->real - other.real, this->imag - other.imag);
-    }
-    Complex operator*(const Complex& other) { // complex * complex
-        Complex result;
-        result.real = this->real * other.real - this->imag * other.imag;
-        result.imag = this->imag * other.real + this->real * other.imag;
-        return result;
-    }
-
-    Complex operator+(const float& num) { // complex + float
-        return Complex(this->real + num, this->imag);
-    }
-    Complex operator-(const float& num) { // complex + float
-        return Complex(this->real - num, this->imag);
-    }
-    Complex operator*(const float& num) { // complex * float
-        return Complex(this->real * num, this->imag * num);
-    }
-    Complex operator/(const float& num) { // complex / float
-        return Complex(this->real / num, this->imag / num);
-    }
-    float lenSq() { // Calculate the squared length of complex
-        return (this->real * this->real + this->imag * this->imag);
-    }
-};
 struct ComplexPlane {
     Complex lu; // left up
     Complex ru; // right up
@@ -70,7 +39,6 @@ enum Tag {
 };
 
 /* Function Declarition */
-int calculatePixel(Complex startPoint, float scaleW, int indexW, float scaleH, int indexH);
 int saveAsBmpFile(int w, int h, BYTE* pixelData); // Save pixelData as BMP to BMP_PATH
 
 
@@ -80,6 +48,7 @@ int main(int argc, char* argv[])
     Complex complexPlaneLU(-2.0, -2.0);
     Complex complexPlaneSize(4.0, 4.0);
     ComplexPlane complexPlane(complexPlaneLU, complexPlaneSize);
+    FractalKernel kernel;
 
     // Mapping scales
     float scaleW = complexPlaneSize.real / EDGE_PIXEL_NUM;
@@ -109,6 +78,13 @@ int main(int argc, char* argv[])
     if (myRank == 0) { // Master
 
         BYTE* bmpData = new BYTE[EDGE_PIXEL_NUM * EDGE_PIXEL_NUM];
+        RawImage raw;
+        if (rawCreate(&raw, RAW_PATH, EDGE_PIXEL_NUM, EDGE_PIXEL_NUM, COLOR_LEVEL_MAX,
+                      complexPlaneLU.real, complexPlaneLU.imag, complexPlaneSize.real, complexPlaneSize.imag,
+                      FractalKernel::ID, kernel.param().real, kernel.param().imag) != 0) {
+            printf("ERROR: Cannot create raw file %s.\n", RAW_PATH);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
 
         // Buffer preparation
         int sendBuffer[2]; // [startColNo, endColNo]
@@ -135,11 +111,13 @@ int main(int argc, char* argv[])
         for (int i = 0; i < EDGE_PIXEL_NUM * EDGE_PIXEL_NUM; i ++) {
             MPI_Recv(recvBuffer, 3, MPI_INT, MPI_ANY_SOURCE, TAG_DATA, MPI_COMM_WORLD, &status);
             bmpData[recvBuffer[0] * EDGE_PIXEL_NUM + recvBuffer[1]] = recvBuffer[2]; // Fill the pixel data
+            rawSetPixel(&raw, recvBuffer[0], recvBuffer[1], recvBuffer[2]);
         }
 
         // BMP generation & Memory Releas
         saveAsBmpFile(EDGE_PIXEL_NUM, EDGE_PIXEL_NUM, bmpData);
         delete[]bmpData;
+        rawClose(&raw);
 
         QueryPerformanceCounter(&timeEnd);
         double timeDiff = (double)(timeEnd.QuadPart - timeStart.QuadPart) / (double)timeFreq.QuadPart;
@@ -159,7 +137,7 @@ int main(int argc, char* argv[])
             for (int j = recvBuffer[0]; j < recvBuffer[1]; j ++) {
                 sendBuffer[0] = i;
                 sendBuffer[1] = j;
-                sendBuffer[2] = calculatePixel(complexPlane.lu, scaleW, i, scaleH, j);
+                sendBuffer[2] = calculatePixel(kernel, complexPlane.lu, scaleW, i, scaleH, j, COLOR_LEVEL_MAX);
                 MPI_Send(sendBuffer, 3, MPI_INT, 0, TAG_DATA, MPI_COMM_WORLD);
             }
         }
@@ -172,20 +150,6 @@ int main(int argc, char* argv[])
     return 0;
 }
 
-int calculatePixel(Complex planeOrigin, float scaleW, int indexW, float scaleH, int indexH) {
-    Complex offset(scaleW * indexW, scaleH * indexH);
-    Complex c = planeOrigin + offset; // Mapping
-
-    int count = 0;
-    Complex z(0.0, 0.0);
-    do {
-        z = z * z + c;
-        count ++;
-    } while (z.lenSq() < 4.0 && count < COLOR_LEVEL_MAX);
-
-    return count;
-}
-
 /* Generate grayscale BMP file from pixel data */
 
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)